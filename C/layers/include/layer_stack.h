@@ -0,0 +1,188 @@
+#ifndef LAYER_STACK_H
+#define LAYER_STACK_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "opendal.h"
+
+/*
+
+Layer stack for the OpenDAL C binding.
+
+The C binding only exposes services (opendal_operator_new + service options), the layers
+available in Rust (RetryLayer, ConcurrentLimitLayer, TimeoutLayer, ThrottleLayer, ChaosLayer)
+are not reachable from C. This wraps an opendal_operator with the same set of layers, applied
+in this order (outermost first):
+
+    retry -> throttle -> concurrent limit -> timeout -> chaos -> operator
+
+- Retry: exponential backoff with full jitter, only for temporary errors
+  (OPENDAL_UNEXPECTED, OPENDAL_RATE_LIMITED, timeouts and injected errors). A mutation that
+  timed out after reaching the operator is not retried, see the timeout layer
+
+- Throttle: token bucket over the bytes moved by read/write (bytes/sec + burst). The wait
+  happens before the attempt deadline starts, so throttling never causes timeouts. Writes wait
+  for their own bytes, reads are charged once the data is back and the next attempts pay the debt
+
+- Concurrent limit: at most N attempts in flight, waiting for a permit counts against the timeout
+
+- Timeout: per attempt deadline. The C API is blocking, so the attempt runs on a pool of
+  concurrent_limit worker threads and is abandoned (not cancelled) when the deadline passes.
+  The worker keeps its permit until the underlying call returns, so stuck calls can never
+  exceed the concurrent limit. Requires a concurrent limit.
+  An attempt that times out before reaching the operator (waiting for a permit or a worker)
+  is skipped. Once the operator call started, a mutation (write, delete, create_dir, rename,
+  copy, opening a writer) failing with LAYER_ERROR_TIMEOUT has an unknown outcome
+  (may_still_apply is set): it may still be applied later, even after a newer mutation of the
+  same path, replacing its result
+
+- Chaos: fault injection, meant for testing and benchmarking. Errors fail the attempt before
+  the operator call, stalls delay it after it started (a slow backend)
+
+Every layer is disabled by default (zero value), like in Rust where layers are opt-in.
+
+Layers apply to a single call: opening a lister, reader or writer goes through the stack,
+but lister_next, reader_read and writer_write on the returned handle call the binding directly.
+Operations that are not wrapped (presign, operator info, ...) can use layer_stack_operator,
+those calls bypass every layer.
+
+*/
+
+typedef struct layer_stack_options {
+    // Retry (retry_max_times = 0 disables it)
+    uint32_t retry_max_times;
+    uint32_t retry_min_delay_ms;
+    uint32_t retry_max_delay_ms;
+    double retry_factor;
+    bool retry_jitter;
+
+    // Concurrent limit (0 disables it)
+    uint32_t concurrent_limit;
+
+    // Timeout per attempt (0 disables it), requires concurrent_limit > 0
+    uint32_t timeout_ms;
+
+    // Throttle in bytes/sec (0 disables it), burst defaults to one second of bandwidth
+    uint64_t throttle_bandwidth;
+    uint64_t throttle_burst;
+
+    // Chaos (ratios between 0 and 1)
+    double chaos_error_ratio;
+    double chaos_stall_ratio;
+    uint32_t chaos_stall_ms;
+} layer_stack_options;
+
+typedef enum layer_error_kind {
+    LAYER_ERROR_OPENDAL, // Error returned by the operator, see `inner`
+    LAYER_ERROR_TIMEOUT, // Attempt deadline passed (includes waiting for a permit), see `may_still_apply`
+    LAYER_ERROR_CHAOS,   // Error injected by the chaos layer
+} layer_error_kind;
+
+typedef struct layer_error {
+    layer_error_kind kind;
+    opendal_error* inner; // Only set for LAYER_ERROR_OPENDAL (owned)
+    uint32_t attempts;    // Attempts made before giving up
+
+    // Mutation (write, delete, create_dir, rename, copy, writer) timed out after the operator
+    // call started, it may still be applied later.
+    // False for a timeout that never reached the operator, which was not applied
+    bool may_still_apply;
+} layer_error;
+
+typedef struct layer_result_read {
+    opendal_bytes data; // Free with opendal_bytes_free
+    layer_error* error;
+} layer_result_read;
+
+typedef struct layer_result_exists {
+    bool exists;
+    layer_error* error;
+} layer_result_exists;
+
+typedef struct layer_result_stat {
+    opendal_metadata* meta; // Free with opendal_metadata_free
+    layer_error* error;
+} layer_result_stat;
+
+typedef struct layer_result_list {
+    opendal_lister* lister; // Free with opendal_lister_free
+    layer_error* error;
+} layer_result_list;
+
+typedef struct layer_result_reader {
+    opendal_reader* reader; // Free with opendal_reader_free
+    layer_error* error;
+} layer_result_reader;
+
+typedef struct layer_result_writer {
+    opendal_writer* writer; // Free with opendal_writer_free (flushes the data)
+    layer_error* error;
+} layer_result_writer;
+
+typedef struct layer_stack layer_stack;
+
+// Returns the options with every layer disabled
+layer_stack_options layer_stack_options_default(void);
+
+/**
+ * Sets an option by key, similar to opendal_operator_options_set.
+ *
+ * Keys: retry.max_times, retry.min_delay_ms, retry.max_delay_ms, retry.factor, retry.jitter,
+ * concurrent_limit, timeout_ms, throttle.bandwidth, throttle.burst,
+ * chaos.error_ratio, chaos.stall_ratio, chaos.stall_ms
+ *
+ * Returns 0 on success, -1 for an unknown key or an invalid value.
+ */
+int layer_stack_options_set(layer_stack_options* opts, const char* key, const char* value);
+
+/**
+ * Wraps the operator with the configured layers. The stack takes ownership of the operator
+ * (like Operator::layer in Rust), do not free it afterwards.
+ *
+ * With a timeout, this also starts the worker pool (concurrent_limit threads).
+ *
+ * Returns NULL if the operator is NULL, the options are invalid (NaN ratios, non-finite factor,
+ * ratios outside [0, 1], retry factor below 1, min delay above max delay or a timeout without
+ * a concurrent limit) or the worker pool could not be started. In that case the operator is
+ * not taken, the caller still has to free it.
+ */
+layer_stack* layer_stack_new(opendal_operator* op, const layer_stack_options* opts);
+
+/**
+ * Releases the stack. The worker pool finishes the attempts abandoned by the timeout layer
+ * before exiting, the operator is only freed after the last one returns.
+ */
+void layer_stack_free(layer_stack* stack);
+
+// Operations (same semantics as the opendal_operator_* counterparts)
+layer_error* layer_stack_write(layer_stack* stack, const char* path, const opendal_bytes* bytes);
+layer_result_read layer_stack_read(layer_stack* stack, const char* path);
+layer_error* layer_stack_delete(layer_stack* stack, const char* path);
+layer_result_exists layer_stack_exists(layer_stack* stack, const char* path);
+layer_result_stat layer_stack_stat(layer_stack* stack, const char* path);
+layer_result_list layer_stack_list(layer_stack* stack, const char* path);
+layer_error* layer_stack_create_dir(layer_stack* stack, const char* path);
+layer_error* layer_stack_rename(layer_stack* stack, const char* src, const char* dest);
+layer_error* layer_stack_copy(layer_stack* stack, const char* src, const char* dest);
+
+/**
+ * Opening goes through the layers, reads/writes on the returned handle do not.
+ * A writer abandoned by the timeout layer is freed by the worker, which flushes it, so opening
+ * a writer is treated like a write (may_still_apply, not retried after a timeout).
+ */
+layer_result_reader layer_stack_reader(layer_stack* stack, const char* path);
+layer_result_writer layer_stack_writer(layer_stack* stack, const char* path);
+
+/**
+ * The wrapped operator, still owned by the stack (do not free it). Calls made on it bypass
+ * every layer, meant for operations the stack does not wrap.
+ */
+const opendal_operator* layer_stack_operator(const layer_stack* stack);
+
+// Frees the error and the inner opendal_error (if any)
+void layer_error_free(layer_error* error);
+
+// Human readable name of the error kind
+const char* layer_error_kind_name(layer_error_kind kind);
+
+#endif
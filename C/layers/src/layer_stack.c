@@ -0,0 +1,802 @@
+#include <ctype.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "layer_stack.h"
+
+#define NS_PER_MS 1000000ULL
+#define NS_PER_SEC 1000000000ULL
+
+// Pool threads run the blocking binding (a Rust runtime block_on), debug builds of
+// libopendal_c need more than PTHREAD_STACK_MIN but far less than the 8 MiB default
+#define LAYER_WORKER_STACK_SIZE (512 * 1024)
+
+typedef struct layer_job layer_job;
+
+struct layer_stack {
+    opendal_operator* op;
+    layer_stack_options opts;
+    atomic_uint refs;
+
+    // Concurrent limit
+    pthread_mutex_t permit_lock;
+    pthread_cond_t permit_cond;
+    uint32_t permits;
+
+    // Throttle (tokens can go negative, the caller sleeps off the debt outside the lock)
+    pthread_mutex_t throttle_lock;
+    double tokens;
+    uint64_t last_refill_ns;
+
+    // Timeout worker pool (concurrent_limit threads, only with timeout_ms > 0)
+    pthread_mutex_t pool_lock;
+    pthread_cond_t pool_cond;
+    layer_job* queue_head;
+    layer_job* queue_tail;
+    bool shutdown;
+};
+
+typedef enum layer_op {
+    LAYER_OP_WRITE,
+    LAYER_OP_READ,
+    LAYER_OP_DELETE,
+    LAYER_OP_EXISTS,
+    LAYER_OP_STAT,
+    LAYER_OP_LIST,
+    LAYER_OP_READER,
+    LAYER_OP_WRITER,
+    LAYER_OP_CREATE_DIR,
+    LAYER_OP_RENAME,
+    LAYER_OP_COPY,
+} layer_op;
+
+// Arguments of a call
+typedef struct layer_request {
+    layer_op op;
+    const char* path;
+    const char* dest;           // Rename/copy only
+    const opendal_bytes* bytes; // Write only
+} layer_request;
+
+// Outcome of a single attempt
+typedef struct layer_attempt {
+    bool failed;
+    layer_error_kind kind;
+    opendal_error* error;
+    opendal_bytes data;
+    bool exists;
+    void* handle; // Metadata, lister, reader or writer, depending on the op
+    bool abandoned; // Timed out after reaching the operator, the call may still complete later
+} layer_attempt;
+
+// Attempt queued on the worker pool (timeout layer)
+struct layer_job {
+    layer_job* next;
+    layer_request req; // Points to the copies below, the caller may be gone when the worker runs
+    char* path;
+    char* dest;
+    opendal_bytes bytes;
+    layer_attempt attempt;
+
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    bool started; // The operator call began, it can no longer be skipped
+    bool done;
+    bool abandoned;
+};
+
+// Helpers
+////////////////////////////////
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NS_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+static struct timespec to_timespec(uint64_t ns) {
+    return (struct timespec) {
+        .tv_sec = (time_t)(ns / NS_PER_SEC),
+        .tv_nsec = (long)(ns % NS_PER_SEC)
+    };
+}
+
+static void sleep_ns(uint64_t ns) {
+    struct timespec ts = to_timespec(ns);
+    while (nanosleep(&ts, &ts) == -1 && errno == EINTR);
+}
+
+// Condition variables wait on CLOCK_MONOTONIC so deadlines are not affected by clock changes
+static void init_monotonic_cond(pthread_cond_t* cond) {
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+// xorshift64* per thread, good enough for jitter and fault injection
+static double random_unit(void) {
+    static _Thread_local uint64_t state = 0;
+    if (state == 0) {
+        state = now_ns() ^ (uint64_t)(uintptr_t)&state;
+        if (state == 0) state = 0x9E3779B97F4A7C15ULL;
+    }
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return (double)((state * 0x2545F4914F6CDD1DULL) >> 11) / (double)(1ULL << 53);
+}
+
+static void stack_ref(layer_stack* stack) {
+    atomic_fetch_add(&stack->refs, 1);
+}
+
+static void stack_unref(layer_stack* stack) {
+    if (atomic_fetch_sub(&stack->refs, 1) != 1) return;
+
+    // NULL when layer_stack_new failed, the operator then stays with the caller
+    if (stack->op != NULL) opendal_operator_free(stack->op);
+    pthread_mutex_destroy(&stack->permit_lock);
+    pthread_cond_destroy(&stack->permit_cond);
+    pthread_mutex_destroy(&stack->throttle_lock);
+    pthread_mutex_destroy(&stack->pool_lock);
+    pthread_cond_destroy(&stack->pool_cond);
+    free(stack);
+}
+
+static void attempt_clear(layer_op op, layer_attempt* attempt) {
+    if (attempt->error != NULL) opendal_error_free(attempt->error);
+    if (attempt->data.data != NULL) opendal_bytes_free(&attempt->data);
+    if (attempt->handle != NULL) {
+        switch (op) {
+            case LAYER_OP_STAT: opendal_metadata_free(attempt->handle); break;
+            case LAYER_OP_LIST: opendal_lister_free(attempt->handle); break;
+            case LAYER_OP_READER: opendal_reader_free(attempt->handle); break;
+            case LAYER_OP_WRITER: opendal_writer_free(attempt->handle); break;
+            default: break;
+        }
+    }
+    *attempt = (layer_attempt) {0};
+}
+
+// Freeing an abandoned writer flushes it, so opening one counts as a mutation
+static bool op_is_mutation(layer_op op) {
+    switch (op) {
+        case LAYER_OP_WRITE:
+        case LAYER_OP_DELETE:
+        case LAYER_OP_WRITER:
+        case LAYER_OP_CREATE_DIR:
+        case LAYER_OP_RENAME:
+        case LAYER_OP_COPY:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool attempt_is_temporary(layer_op op, const layer_attempt* attempt) {
+    // An abandoned write/delete can still land after the retry and overwrite its result
+    if (attempt->abandoned && op_is_mutation(op)) return false;
+    if (attempt->kind != LAYER_ERROR_OPENDAL) return true;
+    return attempt->error->code == OPENDAL_UNEXPECTED || attempt->error->code == OPENDAL_RATE_LIMITED;
+}
+
+// Concurrent limit
+////////////////////////////////
+
+// deadline_ns = 0 waits forever
+static bool permit_acquire(layer_stack* stack, uint64_t deadline_ns) {
+    if (stack->opts.concurrent_limit == 0) return true;
+
+    struct timespec deadline = to_timespec(deadline_ns);
+    bool acquired = true;
+
+    pthread_mutex_lock(&stack->permit_lock);
+    while (stack->permits == 0) {
+        if (deadline_ns == 0) {
+            pthread_cond_wait(&stack->permit_cond, &stack->permit_lock);
+        } else if (pthread_cond_timedwait(&stack->permit_cond, &stack->permit_lock, &deadline) == ETIMEDOUT) {
+            acquired = stack->permits > 0;
+            break;
+        }
+    }
+    if (acquired) stack->permits--;
+    pthread_mutex_unlock(&stack->permit_lock);
+
+    return acquired;
+}
+
+static void permit_release(layer_stack* stack) {
+    if (stack->opts.concurrent_limit == 0) return;
+
+    pthread_mutex_lock(&stack->permit_lock);
+    stack->permits++;
+    pthread_cond_signal(&stack->permit_cond);
+    pthread_mutex_unlock(&stack->permit_lock);
+}
+
+// Throttle
+////////////////////////////////
+
+// Takes the bytes from the bucket and returns the debt left, in bytes
+static double throttle_take(layer_stack* stack, uint64_t bytes) {
+    double bandwidth = (double)stack->opts.throttle_bandwidth;
+    double debt;
+
+    pthread_mutex_lock(&stack->throttle_lock);
+    uint64_t now = now_ns();
+    stack->tokens += (double)(now - stack->last_refill_ns) * bandwidth / (double)NS_PER_SEC;
+    if (stack->tokens > (double)stack->opts.throttle_burst) {
+        stack->tokens = (double)stack->opts.throttle_burst;
+    }
+    stack->last_refill_ns = now;
+    stack->tokens -= (double)bytes;
+    debt = -stack->tokens;
+    pthread_mutex_unlock(&stack->throttle_lock);
+
+    return debt;
+}
+
+// Takes the bytes and sleeps off the debt, bytes = 0 only pays the debt left by reads
+static void throttle(layer_stack* stack, uint64_t bytes) {
+    if (stack->opts.throttle_bandwidth == 0) return;
+
+    double debt = throttle_take(stack, bytes);
+    if (debt > 0) sleep_ns((uint64_t)(debt / (double)stack->opts.throttle_bandwidth * (double)NS_PER_SEC));
+}
+
+// Read sizes are only known once the data is back, they become debt for the next attempts
+// instead of a sleep that could push a completed read past its deadline
+static void throttle_charge(layer_stack* stack, uint64_t bytes) {
+    if (stack->opts.throttle_bandwidth == 0 || bytes == 0) return;
+    throttle_take(stack, bytes);
+}
+
+// Attempt (chaos -> operator)
+////////////////////////////////
+
+// Returns false if the caller gave up before the call started, job = NULL runs inline
+static bool job_start(layer_job* job) {
+    if (job == NULL) return true;
+
+    pthread_mutex_lock(&job->lock);
+    bool start = !job->abandoned;
+    job->started = start;
+    pthread_mutex_unlock(&job->lock);
+
+    return start;
+}
+
+static void run_attempt(layer_stack* stack, layer_job* job, const layer_request* req, layer_attempt* attempt) {
+    const layer_stack_options* opts = &stack->opts;
+    *attempt = (layer_attempt) {0};
+
+    if (opts->chaos_error_ratio > 0 && random_unit() < opts->chaos_error_ratio) {
+        attempt->failed = true;
+        attempt->kind = LAYER_ERROR_CHAOS;
+        return;
+    }
+    if (!job_start(job)) {
+        attempt->failed = true;
+        attempt->kind = LAYER_ERROR_TIMEOUT;
+        return;
+    }
+
+    // Stalls model a slow backend, the request is already in flight
+    if (opts->chaos_stall_ratio > 0 && random_unit() < opts->chaos_stall_ratio) {
+        sleep_ns((uint64_t)opts->chaos_stall_ms * NS_PER_MS);
+    }
+
+    switch (req->op) {
+        case LAYER_OP_WRITE:
+            attempt->error = opendal_operator_write(stack->op, req->path, req->bytes);
+            break;
+        case LAYER_OP_READ: {
+            opendal_result_read r = opendal_operator_read(stack->op, req->path);
+            attempt->error = r.error;
+            if (r.error == NULL) attempt->data = r.data;
+            break;
+        }
+        case LAYER_OP_DELETE:
+            attempt->error = opendal_operator_delete(stack->op, req->path);
+            break;
+        case LAYER_OP_EXISTS: {
+            opendal_result_exists r = opendal_operator_exists(stack->op, req->path);
+            attempt->error = r.error;
+            attempt->exists = r.exists;
+            break;
+        }
+        case LAYER_OP_STAT: {
+            opendal_result_stat r = opendal_operator_stat(stack->op, req->path);
+            attempt->error = r.error;
+            attempt->handle = r.meta;
+            break;
+        }
+        case LAYER_OP_LIST: {
+            opendal_result_list r = opendal_operator_list(stack->op, req->path);
+            attempt->error = r.error;
+            attempt->handle = r.lister;
+            break;
+        }
+        case LAYER_OP_READER: {
+            opendal_result_operator_reader r = opendal_operator_reader(stack->op, req->path);
+            attempt->error = r.error;
+            attempt->handle = r.reader;
+            break;
+        }
+        case LAYER_OP_WRITER: {
+            opendal_result_operator_writer r = opendal_operator_writer(stack->op, req->path);
+            attempt->error = r.error;
+            attempt->handle = r.writer;
+            break;
+        }
+        case LAYER_OP_CREATE_DIR:
+            attempt->error = opendal_operator_create_dir(stack->op, req->path);
+            break;
+        case LAYER_OP_RENAME:
+            attempt->error = opendal_operator_rename(stack->op, req->path, req->dest);
+            break;
+        case LAYER_OP_COPY:
+            attempt->error = opendal_operator_copy(stack->op, req->path, req->dest);
+            break;
+    }
+
+    if (attempt->error != NULL) {
+        attempt->failed = true;
+        attempt->kind = LAYER_ERROR_OPENDAL;
+        attempt->handle = NULL;
+    } else if (req->op == LAYER_OP_READ) {
+        throttle_charge(stack, attempt->data.len);
+    }
+}
+
+// Timeout
+////////////////////////////////
+
+static void job_free(layer_job* job) {
+    pthread_mutex_destroy(&job->lock);
+    pthread_cond_destroy(&job->cond);
+    free(job->path);
+    free(job->dest);
+    free(job->bytes.data);
+    free(job);
+}
+
+static void job_run(layer_stack* stack, layer_job* job) {
+    run_attempt(stack, job, &job->req, &job->attempt);
+    permit_release(stack);
+
+    pthread_mutex_lock(&job->lock);
+    if (job->abandoned) {
+        // Nobody is waiting for the result anymore
+        pthread_mutex_unlock(&job->lock);
+        attempt_clear(job->req.op, &job->attempt);
+        job_free(job);
+    } else {
+        job->done = true;
+        pthread_cond_signal(&job->cond);
+        pthread_mutex_unlock(&job->lock);
+    }
+}
+
+// Runs queued jobs until the stack is freed and the queue is drained
+static void* pool_main(void* arg) {
+    layer_stack* stack = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&stack->pool_lock);
+        while (stack->queue_head == NULL && !stack->shutdown) {
+            pthread_cond_wait(&stack->pool_cond, &stack->pool_lock);
+        }
+        layer_job* job = stack->queue_head;
+        if (job != NULL) {
+            stack->queue_head = job->next;
+            if (stack->queue_head == NULL) stack->queue_tail = NULL;
+        }
+        pthread_mutex_unlock(&stack->pool_lock);
+
+        if (job == NULL) break;
+        job_run(stack, job);
+    }
+
+    stack_unref(stack);
+    return NULL;
+}
+
+static void pool_shutdown(layer_stack* stack) {
+    pthread_mutex_lock(&stack->pool_lock);
+    stack->shutdown = true;
+    pthread_cond_broadcast(&stack->pool_cond);
+    pthread_mutex_unlock(&stack->pool_lock);
+}
+
+// Every pool thread holds a reference to the stack, returns false if a thread could not be created
+static bool pool_start(layer_stack* stack, uint32_t threads) {
+    pthread_attr_t attr;
+    pthread_t thread;
+    bool started = true;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, LAYER_WORKER_STACK_SIZE);
+    for (uint32_t i = 0; i < threads && started; i++) {
+        stack_ref(stack);
+        if (pthread_create(&thread, &attr, pool_main, stack) != 0) {
+            stack_unref(stack);
+            started = false;
+        }
+    }
+    pthread_attr_destroy(&attr);
+
+    return started;
+}
+
+static void pool_push(layer_stack* stack, layer_job* job) {
+    pthread_mutex_lock(&stack->pool_lock);
+    if (stack->queue_tail != NULL) {
+        stack->queue_tail->next = job;
+    } else {
+        stack->queue_head = job;
+    }
+    stack->queue_tail = job;
+    pthread_cond_signal(&stack->pool_cond);
+    pthread_mutex_unlock(&stack->pool_lock);
+}
+
+static layer_job* job_new(const layer_request* req) {
+    layer_job* job = calloc(1, sizeof(layer_job));
+    if (job == NULL) return NULL;
+
+    job->req.op = req->op;
+    job->path = strdup(req->path);
+    if (job->path == NULL) {
+        free(job);
+        return NULL;
+    }
+    job->req.path = job->path;
+
+    if (req->dest != NULL) {
+        job->dest = strdup(req->dest);
+        if (job->dest == NULL) {
+            free(job->path);
+            free(job);
+            return NULL;
+        }
+        job->req.dest = job->dest;
+    }
+
+    if (req->bytes != NULL) {
+        // Never NULL, even when empty: the binding builds a Rust slice from it
+        uint8_t* copy = malloc(req->bytes->len > 0 ? req->bytes->len : 1);
+        if (copy == NULL) {
+            free(job->dest);
+            free(job->path);
+            free(job);
+            return NULL;
+        }
+        if (req->bytes->len > 0) memcpy(copy, req->bytes->data, req->bytes->len);
+        job->bytes = (opendal_bytes) {
+            .data = copy,
+            .len = req->bytes->len
+        };
+        job->req.bytes = &job->bytes;
+    }
+
+    pthread_mutex_init(&job->lock, NULL);
+    init_monotonic_cond(&job->cond);
+    return job;
+}
+
+// Runs the attempt on the worker pool and waits until the deadline, the permit is handed over to the job
+static void run_attempt_with_timeout(layer_stack* stack, const layer_request* req, uint64_t deadline_ns, layer_attempt* attempt) {
+    layer_job* job = job_new(req);
+
+    // Out of memory, degrade to running without the timeout
+    if (job == NULL) {
+        run_attempt(stack, NULL, req, attempt);
+        permit_release(stack);
+        return;
+    }
+
+    pool_push(stack, job);
+
+    struct timespec deadline = to_timespec(deadline_ns);
+
+    pthread_mutex_lock(&job->lock);
+    while (!job->done) {
+        if (pthread_cond_timedwait(&job->cond, &job->lock, &deadline) == ETIMEDOUT) break;
+    }
+
+    if (job->done) {
+        pthread_mutex_unlock(&job->lock);
+        *attempt = job->attempt;
+        job->attempt = (layer_attempt) {0};
+        job_free(job);
+    } else {
+        // If the call has not started yet the worker skips it, the timeout is then safe to retry
+        job->abandoned = true;
+        *attempt = (layer_attempt) {
+            .failed = true,
+            .kind = LAYER_ERROR_TIMEOUT,
+            .abandoned = job->started
+        };
+        pthread_mutex_unlock(&job->lock);
+    }
+}
+
+// Retry
+////////////////////////////////
+
+static uint64_t backoff_ns(const layer_stack_options* opts, uint32_t retry) {
+    double delay = (double)opts->retry_min_delay_ms * pow(opts->retry_factor, (double)retry);
+    if (delay > (double)opts->retry_max_delay_ms) delay = (double)opts->retry_max_delay_ms;
+
+    // Full jitter: spreads retries of concurrent callers so they do not hit the service in lockstep
+    if (opts->retry_jitter) delay *= random_unit();
+
+    return (uint64_t)(delay * (double)NS_PER_MS);
+}
+
+// Runs the operation through every layer, returns the number of attempts
+static uint32_t stack_call(layer_stack* stack, const layer_request* req, layer_attempt* attempt) {
+    const layer_stack_options* opts = &stack->opts;
+    uint32_t attempts = 0;
+
+    for (;;) {
+        // Throttle waits happen before the deadline starts, they never turn into timeouts
+        throttle(stack, req->op == LAYER_OP_WRITE ? req->bytes->len : 0);
+
+        uint64_t deadline_ns = opts->timeout_ms > 0 ? now_ns() + (uint64_t)opts->timeout_ms * NS_PER_MS : 0;
+        attempts++;
+
+        if (!permit_acquire(stack, deadline_ns)) {
+            *attempt = (layer_attempt) {
+                .failed = true,
+                .kind = LAYER_ERROR_TIMEOUT
+            };
+        } else if (deadline_ns > 0) {
+            run_attempt_with_timeout(stack, req, deadline_ns, attempt);
+        } else {
+            run_attempt(stack, NULL, req, attempt);
+            permit_release(stack);
+        }
+
+        if (!attempt->failed || !attempt_is_temporary(req->op, attempt) || attempts > opts->retry_max_times) {
+            return attempts;
+        }
+
+        attempt_clear(req->op, attempt);
+        sleep_ns(backoff_ns(opts, attempts - 1));
+    }
+}
+
+static layer_error* make_error(layer_op op, layer_attempt* attempt, uint32_t attempts) {
+    layer_error* error = malloc(sizeof(layer_error));
+    if (error == NULL) abort();
+
+    *error = (layer_error) {
+        .kind = attempt->kind,
+        .inner = attempt->error,
+        .attempts = attempts,
+        .may_still_apply = attempt->abandoned && op_is_mutation(op)
+    };
+    attempt->error = NULL;
+    return error;
+}
+
+// Public API
+////////////////////////////////
+
+layer_stack_options layer_stack_options_default(void) {
+    // Same retry defaults as the Rust RetryLayer, disabled until retry_max_times is set
+    return (layer_stack_options) {
+        .retry_max_times = 0,
+        .retry_min_delay_ms = 1000,
+        .retry_max_delay_ms = 60000,
+        .retry_factor = 2.0,
+        .retry_jitter = false,
+    };
+}
+
+static int parse_u64(const char* value, uint64_t max, uint64_t* out) {
+    char* end;
+    errno = 0;
+    // strtoull skips leading whitespace and accepts a sign ("-1" wraps to UINT64_MAX), only take digits
+    if (!isdigit((unsigned char)*value)) return -1;
+    unsigned long long parsed = strtoull(value, &end, 10);
+    if (errno != 0 || end == value || *end != '\0' || parsed > max) return -1;
+    *out = parsed;
+    return 0;
+}
+
+static int parse_u32(const char* value, uint32_t* out) {
+    uint64_t parsed;
+    if (parse_u64(value, UINT32_MAX, &parsed) != 0) return -1;
+    *out = (uint32_t)parsed;
+    return 0;
+}
+
+static int parse_double(const char* value, double* out) {
+    char* end;
+    errno = 0;
+    double parsed = strtod(value, &end);
+    if (errno != 0 || end == value || *end != '\0' || !isfinite(parsed)) return -1;
+    *out = parsed;
+    return 0;
+}
+
+static int parse_bool(const char* value, bool* out) {
+    if (strcmp(value, "true") == 0 || strcmp(value, "1") == 0) {
+        *out = true;
+    } else if (strcmp(value, "false") == 0 || strcmp(value, "0") == 0) {
+        *out = false;
+    } else {
+        return -1;
+    }
+    return 0;
+}
+
+int layer_stack_options_set(layer_stack_options* opts, const char* key, const char* value) {
+    if (opts == NULL || key == NULL || value == NULL) return -1;
+
+    if (strcmp(key, "retry.max_times") == 0) return parse_u32(value, &opts->retry_max_times);
+    if (strcmp(key, "retry.min_delay_ms") == 0) return parse_u32(value, &opts->retry_min_delay_ms);
+    if (strcmp(key, "retry.max_delay_ms") == 0) return parse_u32(value, &opts->retry_max_delay_ms);
+    if (strcmp(key, "retry.factor") == 0) return parse_double(value, &opts->retry_factor);
+    if (strcmp(key, "retry.jitter") == 0) return parse_bool(value, &opts->retry_jitter);
+    if (strcmp(key, "concurrent_limit") == 0) return parse_u32(value, &opts->concurrent_limit);
+    if (strcmp(key, "timeout_ms") == 0) return parse_u32(value, &opts->timeout_ms);
+    if (strcmp(key, "throttle.bandwidth") == 0) return parse_u64(value, UINT64_MAX, &opts->throttle_bandwidth);
+    if (strcmp(key, "throttle.burst") == 0) return parse_u64(value, UINT64_MAX, &opts->throttle_burst);
+    if (strcmp(key, "chaos.error_ratio") == 0) return parse_double(value, &opts->chaos_error_ratio);
+    if (strcmp(key, "chaos.stall_ratio") == 0) return parse_double(value, &opts->chaos_stall_ratio);
+    if (strcmp(key, "chaos.stall_ms") == 0) return parse_u32(value, &opts->chaos_stall_ms);
+
+    return -1;
+}
+
+layer_stack* layer_stack_new(opendal_operator* op, const layer_stack_options* opts) {
+    if (op == NULL || opts == NULL) return NULL;
+    // Options set directly in the struct skip the isfinite check of layer_stack_options_set
+    if (!isfinite(opts->retry_factor) || isnan(opts->chaos_error_ratio) || isnan(opts->chaos_stall_ratio)) return NULL;
+    if (opts->retry_max_times > 0 && (opts->retry_factor < 1.0 || opts->retry_min_delay_ms > opts->retry_max_delay_ms)) return NULL;
+    if (opts->chaos_error_ratio < 0 || opts->chaos_error_ratio > 1) return NULL;
+    if (opts->chaos_stall_ratio < 0 || opts->chaos_stall_ratio > 1) return NULL;
+    // Without a limit, calls stuck past the timeout would pile up without bound
+    if (opts->timeout_ms > 0 && opts->concurrent_limit == 0) return NULL;
+
+    layer_stack* stack = calloc(1, sizeof(layer_stack));
+    if (stack == NULL) return NULL;
+
+    stack->op = op;
+    stack->opts = *opts;
+    atomic_init(&stack->refs, 1);
+
+    pthread_mutex_init(&stack->permit_lock, NULL);
+    init_monotonic_cond(&stack->permit_cond);
+    stack->permits = opts->concurrent_limit;
+
+    if (stack->opts.throttle_burst == 0) stack->opts.throttle_burst = stack->opts.throttle_bandwidth;
+    pthread_mutex_init(&stack->throttle_lock, NULL);
+    stack->tokens = (double)stack->opts.throttle_burst;
+    stack->last_refill_ns = now_ns();
+
+    pthread_mutex_init(&stack->pool_lock, NULL);
+    pthread_cond_init(&stack->pool_cond, NULL);
+    if (opts->timeout_ms > 0 && !pool_start(stack, opts->concurrent_limit)) {
+        stack->op = NULL;
+        pool_shutdown(stack);
+        stack_unref(stack);
+        return NULL;
+    }
+
+    return stack;
+}
+
+void layer_stack_free(layer_stack* stack) {
+    if (stack == NULL) return;
+    pool_shutdown(stack);
+    stack_unref(stack);
+}
+
+// Runs the request and returns its error (NULL on success), the result is left in attempt
+static layer_error* stack_run(layer_stack* stack, const layer_request* req, layer_attempt* attempt) {
+    uint32_t attempts = stack_call(stack, req, attempt);
+    return attempt->failed ? make_error(req->op, attempt, attempts) : NULL;
+}
+
+layer_error* layer_stack_write(layer_stack* stack, const char* path, const opendal_bytes* bytes) {
+    layer_request req = { .op = LAYER_OP_WRITE, .path = path, .bytes = bytes };
+    layer_attempt attempt;
+    return stack_run(stack, &req, &attempt);
+}
+
+layer_result_read layer_stack_read(layer_stack* stack, const char* path) {
+    layer_request req = { .op = LAYER_OP_READ, .path = path };
+    layer_attempt attempt;
+    layer_error* error = stack_run(stack, &req, &attempt);
+    return (layer_result_read) { .data = attempt.data, .error = error };
+}
+
+layer_error* layer_stack_delete(layer_stack* stack, const char* path) {
+    layer_request req = { .op = LAYER_OP_DELETE, .path = path };
+    layer_attempt attempt;
+    return stack_run(stack, &req, &attempt);
+}
+
+layer_result_exists layer_stack_exists(layer_stack* stack, const char* path) {
+    layer_request req = { .op = LAYER_OP_EXISTS, .path = path };
+    layer_attempt attempt;
+    layer_error* error = stack_run(stack, &req, &attempt);
+    return (layer_result_exists) { .exists = attempt.exists, .error = error };
+}
+
+layer_result_stat layer_stack_stat(layer_stack* stack, const char* path) {
+    layer_request req = { .op = LAYER_OP_STAT, .path = path };
+    layer_attempt attempt;
+    layer_error* error = stack_run(stack, &req, &attempt);
+    return (layer_result_stat) { .meta = attempt.handle, .error = error };
+}
+
+layer_result_list layer_stack_list(layer_stack* stack, const char* path) {
+    layer_request req = { .op = LAYER_OP_LIST, .path = path };
+    layer_attempt attempt;
+    layer_error* error = stack_run(stack, &req, &attempt);
+    return (layer_result_list) { .lister = attempt.handle, .error = error };
+}
+
+layer_result_reader layer_stack_reader(layer_stack* stack, const char* path) {
+    layer_request req = { .op = LAYER_OP_READER, .path = path };
+    layer_attempt attempt;
+    layer_error* error = stack_run(stack, &req, &attempt);
+    return (layer_result_reader) { .reader = attempt.handle, .error = error };
+}
+
+layer_result_writer layer_stack_writer(layer_stack* stack, const char* path) {
+    layer_request req = { .op = LAYER_OP_WRITER, .path = path };
+    layer_attempt attempt;
+    layer_error* error = stack_run(stack, &req, &attempt);
+    return (layer_result_writer) { .writer = attempt.handle, .error = error };
+}
+
+layer_error* layer_stack_create_dir(layer_stack* stack, const char* path) {
+    layer_request req = { .op = LAYER_OP_CREATE_DIR, .path = path };
+    layer_attempt attempt;
+    return stack_run(stack, &req, &attempt);
+}
+
+layer_error* layer_stack_rename(layer_stack* stack, const char* src, const char* dest) {
+    layer_request req = { .op = LAYER_OP_RENAME, .path = src, .dest = dest };
+    layer_attempt attempt;
+    return stack_run(stack, &req, &attempt);
+}
+
+layer_error* layer_stack_copy(layer_stack* stack, const char* src, const char* dest) {
+    layer_request req = { .op = LAYER_OP_COPY, .path = src, .dest = dest };
+    layer_attempt attempt;
+    return stack_run(stack, &req, &attempt);
+}
+
+const opendal_operator* layer_stack_operator(const layer_stack* stack) {
+    return stack->op;
+}
+
+void layer_error_free(layer_error* error) {
+    if (error == NULL) return;
+    if (error->inner != NULL) opendal_error_free(error->inner);
+    free(error);
+}
+
+const char* layer_error_kind_name(layer_error_kind kind) {
+    switch (kind) {
+        case LAYER_ERROR_OPENDAL: return "opendal";
+        case LAYER_ERROR_TIMEOUT: return "timeout";
+        case LAYER_ERROR_CHAOS: return "chaos";
+    }
+    return "unknown";
+}
@@ -0,0 +1,267 @@
+#include <assert.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "opendal.h"
+#include "layer_stack.h"
+
+/*
+
+Benchmark of the layer stack under injected failures (memory backend + chaos layer).
+
+Every scenario runs the same workload with the same fault injection (errors and stalls),
+only the layers on top change. Reports goodput (successful ops and bytes per second),
+latency percentiles for every operation (failed ones included) and what happened to the
+writes that timed out: never ran, may still apply, and how many of those actually landed.
+
+*/
+
+#define THREADS 16
+#define OPS_PER_THREAD 500
+#define OBJECT_SIZE 4096
+
+typedef struct scenario {
+    const char* name;
+    const char* note;
+    const char* options[16][2]; // key/value pairs, NULL terminated
+} scenario;
+
+typedef struct worker_args {
+    layer_stack* stack;
+    int id;
+    uint64_t* latencies;
+    uint64_t ok;
+    uint64_t errors[3];     // Indexed by layer_error_kind
+    uint64_t retried;       // Failed even after retrying
+    uint64_t write_timeouts;
+    bool may_still_apply[OPS_PER_THREAD]; // Indexed like latencies, writes only
+} worker_args;
+
+#define RETRY_OPTIONS \
+    { "retry.max_times", "3" }, \
+    { "retry.min_delay_ms", "5" }, \
+    { "retry.max_delay_ms", "50" }, \
+    { "retry.factor", "2" }, \
+    { "retry.jitter", "true" }
+
+static const scenario SCENARIOS[] = {
+    { "no layers", NULL, {
+        { NULL, NULL }
+    }},
+    { "retry", "Recovers injected errors, stalls still cost 200ms", {
+        RETRY_OPTIONS,
+        { NULL, NULL }
+    }},
+    { "limit (8 < threads)", "Callers queue behind stalled calls holding permits", {
+        { "concurrent_limit", "8" },
+        { NULL, NULL }
+    }},
+    { "retry + limit (32) + timeout", "Timeouts cut stalls, abandoned calls keep their permit until they return", {
+        RETRY_OPTIONS,
+        { "concurrent_limit", "32" },
+        { "timeout_ms", "20" },
+        { NULL, NULL }
+    }},
+    { "retry + limit (8 < threads) + timeout", "Starvation: abandoned 200ms calls hold most of the 8 permits, "
+        "attempts time out waiting for one and some calls exhaust every retry", {
+        RETRY_OPTIONS,
+        { "concurrent_limit", "8" },
+        { "timeout_ms", "20" },
+        { NULL, NULL }
+    }},
+    { "retry + limit (32) + timeout + throttle", "Goodput capped by the 8 MiB/s bandwidth", {
+        RETRY_OPTIONS,
+        { "concurrent_limit", "32" },
+        { "timeout_ms", "20" },
+        { "throttle.bandwidth", "8388608" }, // 8 MiB/s, below the unthrottled goodput
+        { "throttle.burst", "65536" },        // 16 objects, so the initial burst does not cover the run
+        { NULL, NULL }
+    }},
+};
+
+// Same for every scenario: 5% errors, 2% of the calls stall for 200ms
+#define CHAOS_STALL_MS 200
+#define STRINGIFY(x) #x
+#define TO_STRING(x) STRINGIFY(x)
+static const char* CHAOS_OPTIONS[][2] = {
+    { "chaos.error_ratio", "0.05" },
+    { "chaos.stall_ratio", "0.02" },
+    { "chaos.stall_ms", TO_STRING(CHAOS_STALL_MS) },
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void sleep_ms(uint64_t ms) {
+    struct timespec ts = {
+        .tv_sec = (time_t)(ms / 1000),
+        .tv_nsec = (long)(ms % 1000) * 1000000L
+    };
+    nanosleep(&ts, NULL);
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_ms(const uint64_t* sorted, size_t len, double p) {
+    size_t index = (size_t)(p * (double)(len - 1));
+    return (double)sorted[index] / 1e6;
+}
+
+static void record(worker_args* args, layer_error* error) {
+    if (error == NULL) {
+        args->ok++;
+        return;
+    }
+    args->errors[error->kind]++;
+    if (error->attempts > 1) args->retried++;
+    layer_error_free(error);
+}
+
+// Each iteration writes an object and reads it back (2 ops)
+static void* worker_main(void* arg) {
+    worker_args* args = arg;
+    char path[64];
+    uint8_t payload[OBJECT_SIZE];
+    memset(payload, 'a' + args->id % 26, sizeof(payload));
+
+    opendal_bytes data = {
+        .data = payload,
+        .len = sizeof(payload)
+    };
+
+    for (int i = 0; i < OPS_PER_THREAD; i += 2) {
+        snprintf(path, sizeof(path), "/bench/%d/%d", args->id, i);
+
+        uint64_t start = now_ns();
+        layer_error* error = layer_stack_write(args->stack, path, &data);
+        args->latencies[i] = now_ns() - start;
+        if (error != NULL && error->kind == LAYER_ERROR_TIMEOUT) {
+            args->write_timeouts++;
+            args->may_still_apply[i] = error->may_still_apply;
+        }
+        record(args, error);
+
+        start = now_ns();
+        layer_result_read r = layer_stack_read(args->stack, path);
+        args->latencies[i + 1] = now_ns() - start;
+        if (r.error == NULL) opendal_bytes_free(&r.data);
+        record(args, r.error);
+    }
+
+    return NULL;
+}
+
+static void run_scenario(const scenario* s) {
+    layer_stack_options opts = layer_stack_options_default();
+    for (size_t i = 0; i < sizeof(CHAOS_OPTIONS) / sizeof(CHAOS_OPTIONS[0]); i++) {
+        int res = layer_stack_options_set(&opts, CHAOS_OPTIONS[i][0], CHAOS_OPTIONS[i][1]);
+        assert(res == 0);
+    }
+    for (size_t i = 0; s->options[i][0] != NULL; i++) {
+        int res = layer_stack_options_set(&opts, s->options[i][0], s->options[i][1]);
+        assert(res == 0);
+    }
+
+    opendal_result_operator_new result = opendal_operator_new("memory", NULL);
+    assert(result.op != NULL);
+    assert(result.error == NULL);
+
+    layer_stack* stack = layer_stack_new(result.op, &opts);
+    assert(stack != NULL);
+
+    size_t total_ops = (size_t)THREADS * OPS_PER_THREAD;
+    uint64_t* latencies = malloc(total_ops * sizeof(uint64_t));
+    assert(latencies != NULL);
+
+    pthread_t threads[THREADS];
+    worker_args args[THREADS];
+
+    uint64_t start = now_ns();
+    for (int t = 0; t < THREADS; t++) {
+        args[t] = (worker_args) {
+            .stack = stack,
+            .id = t,
+            .latencies = &latencies[(size_t)t * OPS_PER_THREAD]
+        };
+        int res = pthread_create(&threads[t], NULL, worker_main, &args[t]);
+        assert(res == 0);
+    }
+    for (int t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    double elapsed = (double)(now_ns() - start) / 1e9;
+
+    uint64_t ok = 0, errors[3] = {0}, retried = 0, write_timeouts = 0, may_still_apply = 0, landed = 0;
+    for (int t = 0; t < THREADS; t++) {
+        ok += args[t].ok;
+        retried += args[t].retried;
+        write_timeouts += args[t].write_timeouts;
+        for (int k = 0; k < 3; k++) errors[k] += args[t].errors[k];
+    }
+
+    // Give the abandoned calls time to return, then look for their objects on the raw operator (no chaos)
+    sleep_ms(2 * CHAOS_STALL_MS);
+    const opendal_operator* op = layer_stack_operator(stack);
+    for (int t = 0; t < THREADS; t++) {
+        for (int i = 0; i < OPS_PER_THREAD; i += 2) {
+            if (!args[t].may_still_apply[i]) continue;
+            may_still_apply++;
+
+            char path[64];
+            snprintf(path, sizeof(path), "/bench/%d/%d", t, i);
+            opendal_result_exists e = opendal_operator_exists(op, path);
+            assert(e.error == NULL);
+            if (e.exists) landed++;
+        }
+    }
+
+    qsort(latencies, total_ops, sizeof(uint64_t), compare_u64);
+
+    printf("\n------------ %s ------------\n\n", s->name);
+    if (s->note != NULL) printf("Note: %s\n", s->note);
+    printf("Elapsed: %.2f s\n", elapsed);
+    printf("Success: %" PRIu64 " / %zu (%.2f%%)\n", ok, total_ops, 100.0 * (double)ok / (double)total_ops);
+    printf("Errors: %s=%" PRIu64 " %s=%" PRIu64 " %s=%" PRIu64 "\n",
+        layer_error_kind_name(LAYER_ERROR_OPENDAL), errors[LAYER_ERROR_OPENDAL],
+        layer_error_kind_name(LAYER_ERROR_TIMEOUT), errors[LAYER_ERROR_TIMEOUT],
+        layer_error_kind_name(LAYER_ERROR_CHAOS), errors[LAYER_ERROR_CHAOS]);
+    printf("Failed after retrying: %" PRIu64 "\n", retried);
+    printf("Timed out writes: %" PRIu64 " (never ran: %" PRIu64 ", may still apply: %" PRIu64 ", landed: %" PRIu64 ")\n",
+        write_timeouts, write_timeouts - may_still_apply, may_still_apply, landed);
+    printf("Goodput: %.0f ops/s, %.2f MiB/s\n",
+        (double)ok / elapsed, (double)ok * OBJECT_SIZE / elapsed / (1024.0 * 1024.0));
+    printf("Latency (ms): p50=%.3f p90=%.3f p99=%.3f p99.9=%.3f max=%.3f\n",
+        percentile_ms(latencies, total_ops, 0.50),
+        percentile_ms(latencies, total_ops, 0.90),
+        percentile_ms(latencies, total_ops, 0.99),
+        percentile_ms(latencies, total_ops, 0.999),
+        percentile_ms(latencies, total_ops, 1.0));
+
+    // Abandoned attempts keep the operator alive until they return
+    free(latencies);
+    layer_stack_free(stack);
+}
+
+int main(void) {
+    printf("%d threads x %d ops, %d bytes per object\n", THREADS, OPS_PER_THREAD, OBJECT_SIZE);
+    printf("Chaos: error_ratio=%s stall_ratio=%s stall_ms=%s\n",
+        CHAOS_OPTIONS[0][1], CHAOS_OPTIONS[1][1], CHAOS_OPTIONS[2][1]);
+
+    for (size_t i = 0; i < sizeof(SCENARIOS) / sizeof(SCENARIOS[0]); i++) {
+        run_scenario(&SCENARIOS[i]);
+    }
+
+    printf("\n-----------------------------------------\n\n");
+    return 0;
+}